@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BATCH_UDP_ECHO_SERVER_H
+#define BATCH_UDP_ECHO_SERVER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "batch-udp-socket.h"
+
+#include <vector>
+
+namespace ns3 {
+
+// Own namespace so the log component does not clash with the g_log of
+// the program including this header
+namespace batchecho {
+
+NS_LOG_COMPONENT_DEFINE ("BatchUdpEchoServerApplication");
+
+/**
+ * UDP echo server (IPv4 only) on a BatchUdpSocket.
+ *
+ * Every receive callback takes the queued datagrams with RecvBatch and
+ * echoes them with SendBatch until the socket is empty, without events of
+ * its own.  Datagrams that reach the socket at the same time are handed
+ * over together, see BatchUdpSocket.
+ */
+class BatchUdpEchoServer : public Application
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::BatchUdpEchoServer")
+      .SetParent<Application> ()
+      .AddConstructor<BatchUdpEchoServer> ()
+      .AddAttribute ("Port", "Port on which we listen for incoming packets.",
+                     UintegerValue (9),
+                     MakeUintegerAccessor (&BatchUdpEchoServer::m_port),
+                     MakeUintegerChecker<uint16_t> ())
+      .AddAttribute ("MaxBatch", "Most datagrams read from the socket at once.",
+                     UintegerValue (64),
+                     MakeUintegerAccessor (&BatchUdpEchoServer::m_maxBatch),
+                     MakeUintegerChecker<uint32_t> (1))
+    ;
+    return tid;
+  }
+
+  BatchUdpEchoServer ()
+    : m_port (9),
+      m_maxBatch (64)
+  {
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    m_socket = 0;
+    m_batch.clear ();
+    Application::DoDispose ();
+  }
+
+private:
+  virtual void StartApplication (void)
+  {
+    if (m_socket == 0)
+      {
+        m_socket = DynamicCast<BatchUdpSocket> (
+            Socket::CreateSocket (GetNode (), BatchUdpSocketFactory::GetTypeId ()));
+        InetSocketAddress local = InetSocketAddress (Ipv4Address::GetAny (), m_port);
+        m_socket->Bind (local);
+      }
+    m_socket->SetRecvCallback (MakeCallback (&BatchUdpEchoServer::HandleRead, this));
+  }
+
+  virtual void StopApplication (void)
+  {
+    if (m_socket != 0)
+      {
+        m_socket->Close ();
+        m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      }
+  }
+
+  void HandleRead (Ptr<Socket> socket)
+  {
+    while (m_socket->RecvBatch (m_batch, m_maxBatch) > 0)
+      {
+        for (uint32_t i = 0; i < m_batch.size (); ++i)
+          {
+            Ptr<Packet> packet = m_batch[i].packet;
+            InetSocketAddress from = InetSocketAddress::ConvertFrom (m_batch[i].peer);
+            NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s server received " << packet->GetSize () << " bytes from " <<
+                         from.GetIpv4 () << " port " << from.GetPort ());
+            packet->RemoveAllPacketTags ();
+            packet->RemoveAllByteTags ();
+          }
+        uint32_t sent = m_socket->SendBatch (m_batch);
+        NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s server echoed " << sent <<
+                     " of " << m_batch.size () << " packets");
+        m_batch.clear ();
+      }
+  }
+
+  uint16_t m_port;
+  uint32_t m_maxBatch;
+  Ptr<BatchUdpSocket> m_socket;
+  std::vector<SocketDatagram> m_batch;   // reused between callbacks
+};
+
+NS_OBJECT_ENSURE_REGISTERED (BatchUdpEchoServer);
+
+} // namespace batchecho
+
+using batchecho::BatchUdpEchoServer;
+
+class BatchUdpEchoServerHelper
+{
+public:
+  BatchUdpEchoServerHelper (uint16_t port)
+  {
+    m_factory.SetTypeId (BatchUdpEchoServer::GetTypeId ());
+    SetAttribute ("Port", UintegerValue (port));
+  }
+
+  void SetAttribute (std::string name, const AttributeValue &value)
+  {
+    m_factory.Set (name, value);
+  }
+
+  // Also aggregates a BatchUdpSocketFactory to the node if it has none;
+  // install the internet stack first
+  ApplicationContainer Install (Ptr<Node> node) const
+  {
+    if (node->GetObject<BatchUdpSocketFactory> () == 0)
+      {
+        node->AggregateObject (CreateObject<BatchUdpSocketFactory> ());
+      }
+    Ptr<Application> app = m_factory.Create<BatchUdpEchoServer> ();
+    node->AddApplication (app);
+    return ApplicationContainer (app);
+  }
+
+private:
+  ObjectFactory m_factory;
+};
+
+} // namespace ns3
+
+#endif /* BATCH_UDP_ECHO_SERVER_H */
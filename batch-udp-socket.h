@@ -0,0 +1,482 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BATCH_UDP_SOCKET_H
+#define BATCH_UDP_SOCKET_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/udp-l4-protocol.h"
+
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * One datagram of a batch: the payload and the remote address it came
+ * from or goes to.
+ */
+struct SocketDatagram
+{
+  Ptr<Packet> packet;
+  Address peer;
+};
+
+/**
+ * IPv4 UDP socket that hands received datagrams to the application in
+ * batches, bound directly to a UdpL4Protocol end point.
+ *
+ * UdpSocketImpl tags every datagram with its source address and calls the
+ * receive callback once per datagram.  This socket keeps the source next
+ * to the packet in its queue and notifies once for the first datagram of
+ * a timestamp, as UdpSocketImpl would.  Datagrams that arrive later at the
+ * same timestamp are only queued; the second one schedules a single
+ * notification for the current time, so a burst of k datagrams costs two
+ * callbacks and one event instead of k callbacks, and a lone datagram
+ * costs no event at all.
+ *
+ * RecvBatch () takes several queued datagrams at once, SendBatch () sends
+ * a batch with one route lookup per run of datagrams to the same
+ * destination and one NotifySend for the batch.  The plain Socket calls
+ * work as well.  No broadcast, multicast, ICMP errors or IPv6.
+ */
+class BatchUdpSocket : public Socket
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::BatchUdpSocket")
+      .SetParent<Socket> ()
+      .AddConstructor<BatchUdpSocket> ()
+      .AddAttribute ("RcvBufSize", "Most bytes of datagrams queued for the application.",
+                     UintegerValue (131072),
+                     MakeUintegerAccessor (&BatchUdpSocket::m_rcvBufSize),
+                     MakeUintegerChecker<uint32_t> ())
+      .AddTraceSource ("Drop", "Datagram dropped because the receive buffer is full.",
+                       MakeTraceSourceAccessor (&BatchUdpSocket::m_dropTrace),
+                       "ns3::Packet::TracedCallback")
+    ;
+    return tid;
+  }
+
+  BatchUdpSocket ()
+    : m_endPoint (0),
+      m_errno (ERROR_NOTERROR),
+      m_shutdownSend (false),
+      m_shutdownRecv (false),
+      m_connected (false),
+      m_defaultAddress (Ipv4Address::GetAny (), 0),
+      m_rcvBufSize (131072),
+      m_rxAvailable (0),
+      m_lastNotify (Seconds (-1))
+  {
+  }
+
+  // Node, UDP and IPv4 the socket works on; set by BatchUdpSocketFactory
+  void SetNode (Ptr<Node> node)
+  {
+    m_node = node;
+    m_udp = node->GetObject<UdpL4Protocol> ();
+    m_ipv4 = node->GetObject<Ipv4> ();
+  }
+
+  // Move up to maxBatch queued datagrams to the end of batch; returns how
+  // many were moved, 0 when nothing is queued
+  uint32_t RecvBatch (std::vector<SocketDatagram> &batch, uint32_t maxBatch)
+  {
+    uint32_t n = 0;
+    while (n < maxBatch && !m_queue.empty ())
+      {
+        m_rxAvailable -= m_queue.front ().packet->GetSize ();
+        batch.push_back (m_queue.front ());
+        m_queue.pop_front ();
+        ++n;
+      }
+    return n;
+  }
+
+  // Send the datagrams in order; returns how many were sent, stopping at
+  // the first one that fails (GetErrno () tells why)
+  uint32_t SendBatch (std::vector<SocketDatagram> const &batch)
+  {
+    Ptr<Ipv4Route> route;
+    uint32_t n = 0;
+    uint32_t bytes = 0;
+    while (n < batch.size ()
+           && DoSendTo (batch[n].packet, InetSocketAddress::ConvertFrom (batch[n].peer), route) >= 0)
+      {
+        bytes += batch[n].packet->GetSize ();
+        ++n;
+      }
+    if (n > 0)
+      {
+        NotifyDataSent (bytes);
+        NotifySend (GetTxAvailable ());
+      }
+    return n;
+  }
+
+  virtual enum SocketErrno GetErrno (void) const
+  {
+    return m_errno;
+  }
+  virtual enum SocketType GetSocketType (void) const
+  {
+    return NS3_SOCK_DGRAM;
+  }
+  virtual Ptr<Node> GetNode (void) const
+  {
+    return m_node;
+  }
+
+  virtual int Bind (void)
+  {
+    return FinishBind (m_udp->Allocate ());
+  }
+  virtual int Bind (const Address &address)
+  {
+    if (!InetSocketAddress::IsMatchingType (address))
+      {
+        m_errno = ERROR_INVAL;
+        return -1;
+      }
+    InetSocketAddress local = InetSocketAddress::ConvertFrom (address);
+    Ipv4Address ipv4 = local.GetIpv4 ();
+    uint16_t port = local.GetPort ();
+    if (ipv4 == Ipv4Address::GetAny ())
+      {
+        return FinishBind (port == 0 ? m_udp->Allocate () : m_udp->Allocate (port));
+      }
+    return FinishBind (port == 0 ? m_udp->Allocate (ipv4) : m_udp->Allocate (ipv4, port));
+  }
+  virtual int Bind6 (void)
+  {
+    m_errno = ERROR_AFNOSUPPORT;
+    return -1;
+  }
+
+  virtual int Close (void)
+  {
+    if (m_shutdownRecv && m_shutdownSend)
+      {
+        m_errno = ERROR_BADF;
+        return -1;
+      }
+    m_shutdownRecv = true;
+    m_shutdownSend = true;
+    DeallocateEndPoint ();
+    return 0;
+  }
+  virtual int ShutdownSend (void)
+  {
+    m_shutdownSend = true;
+    return 0;
+  }
+  virtual int ShutdownRecv (void)
+  {
+    m_shutdownRecv = true;
+    return 0;
+  }
+
+  virtual int Connect (const Address &address)
+  {
+    if (!InetSocketAddress::IsMatchingType (address))
+      {
+        m_errno = ERROR_INVAL;
+        return -1;
+      }
+    if (m_endPoint == 0 && Bind () == -1)
+      {
+        return -1;
+      }
+    m_defaultAddress = InetSocketAddress::ConvertFrom (address);
+    m_connected = true;
+    NotifyConnectionSucceeded ();
+    return 0;
+  }
+  virtual int Listen (void)
+  {
+    m_errno = ERROR_OPNOTSUPP;
+    return -1;
+  }
+
+  virtual uint32_t GetTxAvailable (void) const
+  {
+    // largest IPv4 UDP payload, there is no send buffer
+    return 65507;
+  }
+  virtual int Send (Ptr<Packet> p, uint32_t flags)
+  {
+    if (!m_connected)
+      {
+        m_errno = ERROR_NOTCONN;
+        return -1;
+      }
+    return SendTo (p, flags, m_defaultAddress);
+  }
+  virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress)
+  {
+    if (!InetSocketAddress::IsMatchingType (toAddress))
+      {
+        m_errno = ERROR_AFNOSUPPORT;
+        return -1;
+      }
+    Ptr<Ipv4Route> route;
+    int sent = DoSendTo (p, InetSocketAddress::ConvertFrom (toAddress), route);
+    if (sent >= 0)
+      {
+        NotifyDataSent (sent);
+        NotifySend (GetTxAvailable ());
+      }
+    return sent;
+  }
+
+  virtual uint32_t GetRxAvailable (void) const
+  {
+    return m_rxAvailable;
+  }
+  virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags)
+  {
+    Address from;
+    return RecvFrom (maxSize, flags, from);
+  }
+  virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress)
+  {
+    // like UdpSocketImpl, a datagram larger than maxSize stays queued
+    if (m_queue.empty () || m_queue.front ().packet->GetSize () > maxSize)
+      {
+        return 0;
+      }
+    Ptr<Packet> p = m_queue.front ().packet;
+    fromAddress = m_queue.front ().peer;
+    m_rxAvailable -= p->GetSize ();
+    m_queue.pop_front ();
+    return p;
+  }
+
+  virtual int GetSockName (Address &address) const
+  {
+    if (m_endPoint == 0)
+      {
+        address = InetSocketAddress (Ipv4Address::GetZero (), 0);
+        return 0;
+      }
+    address = InetSocketAddress (m_endPoint->GetLocalAddress (), m_endPoint->GetLocalPort ());
+    return 0;
+  }
+  virtual int GetPeerName (Address &address) const
+  {
+    if (!m_connected)
+      {
+        m_errno = ERROR_NOTCONN;
+        return -1;
+      }
+    address = m_defaultAddress;
+    return 0;
+  }
+
+  virtual bool SetAllowBroadcast (bool allowBroadcast)
+  {
+    return !allowBroadcast;
+  }
+  virtual bool GetAllowBroadcast (void) const
+  {
+    return false;
+  }
+
+protected:
+  virtual void DoDispose (void)
+  {
+    Simulator::Cancel (m_notify);
+    m_queue.clear ();
+    DeallocateEndPoint ();
+    m_node = 0;
+    m_udp = 0;
+    m_ipv4 = 0;
+    Socket::DoDispose ();
+  }
+
+private:
+  int FinishBind (Ipv4EndPoint *endPoint)
+  {
+    if (endPoint == 0)
+      {
+        m_errno = ERROR_ADDRINUSE;
+        return -1;
+      }
+    DeallocateEndPoint ();
+    m_endPoint = endPoint;
+    m_endPoint->SetRxCallback (MakeCallback (&BatchUdpSocket::ForwardUp, Ptr<BatchUdpSocket> (this)));
+    m_endPoint->SetDestroyCallback (MakeCallback (&BatchUdpSocket::Destroy, Ptr<BatchUdpSocket> (this)));
+    m_shutdownRecv = false;
+    m_shutdownSend = false;
+    return 0;
+  }
+
+  void DeallocateEndPoint (void)
+  {
+    if (m_endPoint != 0)
+      {
+        m_endPoint->SetDestroyCallback (MakeNullCallback<void> ());
+        m_udp->DeAllocate (m_endPoint);
+        m_endPoint = 0;
+      }
+  }
+
+  // UdpL4Protocol is being disposed and deletes the end point itself
+  void Destroy (void)
+  {
+    m_endPoint = 0;
+  }
+
+  void ForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port,
+                  Ptr<Ipv4Interface> incomingInterface)
+  {
+    if (m_shutdownRecv)
+      {
+        return;
+      }
+    if (m_rxAvailable + packet->GetSize () > m_rcvBufSize)
+      {
+        m_dropTrace (packet);
+        return;
+      }
+    SocketDatagram d;
+    d.packet = packet;
+    d.peer = InetSocketAddress (header.GetSource (), port);
+    m_queue.push_back (d);
+    m_rxAvailable += packet->GetSize ();
+
+    if (m_lastNotify != Simulator::Now ())
+      {
+        m_lastNotify = Simulator::Now ();
+        NotifyDataRecv ();
+      }
+    else if (!m_notify.IsRunning ())
+      {
+        m_notify = Simulator::ScheduleNow (&BatchUdpSocket::NotifyBatch, this);
+      }
+  }
+
+  void NotifyBatch (void)
+  {
+    if (!m_queue.empty ())
+      {
+        NotifyDataRecv ();
+      }
+  }
+
+  // route is reused while the destination stays the same, callers pass a
+  // null route for every new batch
+  int DoSendTo (Ptr<Packet> p, InetSocketAddress const &to, Ptr<Ipv4Route> &route)
+  {
+    if (m_endPoint == 0 && Bind () == -1)
+      {
+        return -1;
+      }
+    if (m_shutdownSend)
+      {
+        m_errno = ERROR_SHUTDOWN;
+        return -1;
+      }
+    if (p->GetSize () > GetTxAvailable ())
+      {
+        m_errno = ERROR_MSGSIZE;
+        return -1;
+      }
+    Ipv4Address dest = to.GetIpv4 ();
+    if (route == 0 || route->GetDestination () != dest)
+      {
+        Ptr<Ipv4RoutingProtocol> routing = m_ipv4->GetRoutingProtocol ();
+        if (routing == 0)
+          {
+            m_errno = ERROR_NOROUTETOHOST;
+            return -1;
+          }
+        Ipv4Header header;
+        header.SetDestination (dest);
+        header.SetProtocol (UdpL4Protocol::PROT_NUMBER);
+        Socket::SocketErrno errno_;
+        route = routing->RouteOutput (p, header, Ptr<NetDevice> (), errno_);
+        if (route == 0)
+          {
+            m_errno = errno_;
+            return -1;
+          }
+      }
+    Ipv4Address source = m_endPoint->GetLocalAddress ();
+    if (source == Ipv4Address::GetAny ())
+      {
+        source = route->GetSource ();
+      }
+    m_udp->Send (p->Copy (), source, dest, m_endPoint->GetLocalPort (), to.GetPort (), route);
+    return p->GetSize ();
+  }
+
+  Ptr<Node> m_node;
+  Ptr<UdpL4Protocol> m_udp;
+  Ptr<Ipv4> m_ipv4;
+  Ipv4EndPoint *m_endPoint;
+  mutable enum SocketErrno m_errno;
+  bool m_shutdownSend;
+  bool m_shutdownRecv;
+  bool m_connected;
+  InetSocketAddress m_defaultAddress;
+  uint32_t m_rcvBufSize;
+  uint32_t m_rxAvailable;
+  std::deque<SocketDatagram> m_queue;
+  Time m_lastNotify;    // when NotifyDataRecv last ran directly from ForwardUp
+  EventId m_notify;     // pending notification for the rest of a burst
+  TracedCallback<Ptr<const Packet> > m_dropTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (BatchUdpSocket);
+
+/**
+ * Creates BatchUdpSockets; aggregate it to a node that has an internet
+ * stack and use Socket::CreateSocket (node, BatchUdpSocketFactory::GetTypeId ()).
+ */
+class BatchUdpSocketFactory : public SocketFactory
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::BatchUdpSocketFactory")
+      .SetParent<SocketFactory> ()
+      .AddConstructor<BatchUdpSocketFactory> ()
+    ;
+    return tid;
+  }
+
+  virtual Ptr<Socket> CreateSocket (void)
+  {
+    Ptr<Node> node = GetObject<Node> ();
+    NS_ASSERT_MSG (node != 0 && node->GetObject<UdpL4Protocol> () != 0,
+                   "BatchUdpSocketFactory needs a node with an internet stack");
+    Ptr<BatchUdpSocket> socket = CreateObject<BatchUdpSocket> ();
+    socket->SetNode (node);
+    return socket;
+  }
+};
+
+NS_OBJECT_ENSURE_REGISTERED (BatchUdpSocketFactory);
+
+} // namespace ns3
+
+#endif /* BATCH_UDP_SOCKET_H */
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Performance regression benchmarks for the project scenarios.
+#
+# Copy this directory into scratch/ of the ns-3 tree and run from the ns-3
+# top level directory:
+#
+#   scratch/bench.sh                     # compare against the baselines
+#   scratch/bench.sh --updateBaseline=1  # record new baselines
+#   TOLERANCE=0.2 scratch/bench.sh       # allow 20% instead of 10%
+#
+# project2, project2.2 and project4 run with a fixed seed at 10, 100 and
+# 1000 STAs per cell and print wall time, events/sec, peak RSS and
+# allocations per event.  project1 schedules a single event and no nodes,
+# too little to time, so it is not part of the set.  Timing differences
+# under 50 ms are not counted (--minWall).
+# The script fails on any regression and on any run without a baseline, so
+# record baselines on the benchmark machine before the first comparison.
+# Build with "./waf configure --build-profile=optimized" first, debug
+# builds are far too slow to be meaningful.
+
+SCRATCH=$(dirname "$0")
+BASELINE=${BASELINE:-$SCRATCH/bench-baselines.txt}
+TOLERANCE=${TOLERANCE:-0.10}
+SIZES=${SIZES:-"10 100 1000"}
+EXTRA="$*"
+
+status=0
+
+run ()
+{
+  ./waf --run "scratch/$1 --bench=1 --seed=1 --baseline=$BASELINE --tolerance=$TOLERANCE $2 $EXTRA" || status=1
+}
+
+for n in $SIZES
+do
+  run project2 "--verbose=0 --nCsma1=$n --nCsma2=$n"
+  run project2.2 "--verbose=0 --nWifi=$n"
+  run project4 "--verbose=0 --nWifi=$n"
+done
+
+exit $status
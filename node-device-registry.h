@@ -0,0 +1,365 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NODE_DEVICE_REGISTRY_H
+#define NODE_DEVICE_REGISTRY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Indexed snapshot of NodeList and every node's devices, used to wire
+ * trace sources on large topologies without Config's object graph walk.
+ *
+ * Node and device data is kept in flat arrays: the devices of node n are
+ * m_devices[m_deviceOffset[n] .. m_deviceOffset[n + 1]), their instance
+ * type is an index into m_types.  A path like
+ *
+ *   /NodeList/<nodes>/DeviceList/<devices>/$ns3::WifiNetDevice/Phy/PhyRxEnd
+ *
+ * is compiled once into node and device index lists plus a per-type match
+ * table, so resolving it is a loop over the selected array slots followed
+ * by the short attribute walk below the device.  <nodes> and <devices>
+ * accept "*", "n", "a|b|c" and "[a-b]" like Config paths.
+ *
+ * Build () takes the snapshot; nodes or devices added afterwards are not
+ * seen until it is called again.
+ */
+class NodeDeviceRegistry
+{
+public:
+  NodeDeviceRegistry ()
+    : m_deviceOffset (1, 0),
+      m_maxDevices (0)
+  {
+  }
+
+  // A resolved trace source: connect with object->TraceConnect* (trace, ...)
+  struct Match
+  {
+    uint32_t node;
+    uint32_t device;
+    Ptr<Object> object;
+    std::string trace;
+  };
+
+  struct CompiledPath
+  {
+    std::vector<uint32_t> nodes;        // empty with allNodes set
+    bool allNodes;
+    std::vector<uint32_t> devices;      // empty with allDevices set
+    bool allDevices;
+    std::vector<uint8_t> typeMatch;     // per m_types entry, if a $Type follows DeviceList
+    TypeId deviceType;
+    bool hasDeviceType;
+    std::vector<std::string> segments;  // attributes/$Types below the device
+    std::vector<TypeId> segmentTypes;   // looked up once for "$" segments
+    std::string trace;
+    std::string suffix;                 // path after the device index, for contexts
+    bool valid;
+  };
+
+  void Build (void)
+  {
+    m_deviceOffset.clear ();
+    m_devices.clear ();
+    m_deviceType.clear ();
+    m_types.clear ();
+    m_maxDevices = 0;
+    m_deviceOffset.reserve (NodeList::GetNNodes () + 1);
+    m_deviceOffset.push_back (0);
+    for (uint32_t n = 0; n < NodeList::GetNNodes (); ++n)
+      {
+        Ptr<Node> node = NodeList::GetNode (n);
+        for (uint32_t d = 0; d < node->GetNDevices (); ++d)
+          {
+            Ptr<NetDevice> device = node->GetDevice (d);
+            m_devices.push_back (device);
+            m_deviceType.push_back (TypeIndex (device->GetInstanceTypeId ()));
+          }
+        m_deviceOffset.push_back (m_devices.size ());
+        m_maxDevices = std::max (m_maxDevices, node->GetNDevices ());
+      }
+  }
+
+  uint32_t GetNNodes (void) const
+  {
+    return m_deviceOffset.size () - 1;
+  }
+
+  uint32_t GetNDevices (uint32_t node) const
+  {
+    return m_deviceOffset[node + 1] - m_deviceOffset[node];
+  }
+
+  Ptr<NetDevice> GetDevice (uint32_t node, uint32_t device) const
+  {
+    return m_devices[m_deviceOffset[node] + device];
+  }
+
+  CompiledPath Compile (std::string const &path) const
+  {
+    CompiledPath c;
+    c.valid = false;
+    c.allNodes = false;
+    c.allDevices = false;
+    c.hasDeviceType = false;
+
+    std::vector<std::string> seg;
+    Split (path, seg);
+    if (seg.size () < 5 || seg[0] != "NodeList" || seg[2] != "DeviceList"
+        || !ParseIndices (seg[1], GetNNodes (), c.nodes, c.allNodes)
+        || !ParseIndices (seg[3], m_maxDevices, c.devices, c.allDevices))
+      {
+        return c;
+      }
+    for (uint32_t i = 4; i < seg.size (); ++i)
+      {
+        c.suffix += "/" + seg[i];
+      }
+    uint32_t first = 4;
+    if (seg[4][0] == '$')
+      {
+        if (!TypeId::LookupByNameFailSafe (seg[4].substr (1), &c.deviceType))
+          {
+            return c;
+          }
+        c.hasDeviceType = true;
+        c.typeMatch.resize (m_types.size ());
+        for (uint32_t t = 0; t < m_types.size (); ++t)
+          {
+            c.typeMatch[t] = m_types[t] == c.deviceType || m_types[t].IsChildOf (c.deviceType);
+          }
+        first = 5;
+      }
+    if (first >= seg.size ())
+      {
+        return c;
+      }
+    for (uint32_t i = first; i + 1 < seg.size (); ++i)
+      {
+        TypeId tid;
+        if (seg[i][0] == '$' && !TypeId::LookupByNameFailSafe (seg[i].substr (1), &tid))
+          {
+            return c;
+          }
+        c.segments.push_back (seg[i]);
+        c.segmentTypes.push_back (tid);
+      }
+    c.trace = seg.back ();
+    c.valid = true;
+    return c;
+  }
+
+  // Append every trace source the path selects to matches
+  void Resolve (CompiledPath const &c, std::vector<Match> &matches) const
+  {
+    if (!c.valid)
+      {
+        return;
+      }
+    uint32_t nNodes = c.allNodes ? GetNNodes () : c.nodes.size ();
+    for (uint32_t i = 0; i < nNodes; ++i)
+      {
+        uint32_t n = c.allNodes ? i : c.nodes[i];
+        if (n >= GetNNodes ())
+          {
+            continue;
+          }
+        uint32_t nDevices = c.allDevices ? GetNDevices (n) : c.devices.size ();
+        for (uint32_t j = 0; j < nDevices; ++j)
+          {
+            uint32_t d = c.allDevices ? j : c.devices[j];
+            if (d >= GetNDevices (n))
+              {
+                continue;
+              }
+            uint32_t slot = m_deviceOffset[n] + d;
+            Ptr<Object> object = m_devices[slot];
+            if (c.hasDeviceType && !c.typeMatch[m_deviceType[slot]])
+              {
+                // not the device itself, maybe an object aggregated to it
+                object = object->GetObject<Object> (c.deviceType);
+              }
+            object = Walk (c, object);
+            if (object != 0)
+              {
+                Match m = { n, d, object, c.trace };
+                matches.push_back (m);
+              }
+          }
+      }
+  }
+
+  // Config::Connect equivalent; returns the number of trace sources connected
+  uint32_t Connect (std::string const &path, CallbackBase const &cb) const
+  {
+    CompiledPath c = Compile (path);
+    std::vector<Match> matches;
+    Resolve (c, matches);
+    uint32_t connected = 0;
+    for (uint32_t i = 0; i < matches.size (); ++i)
+      {
+        std::ostringstream context;
+        context << "/NodeList/" << matches[i].node << "/DeviceList/" << matches[i].device << c.suffix;
+        connected += matches[i].object->TraceConnect (matches[i].trace, context.str (), cb);
+      }
+    return connected;
+  }
+
+  // Config::ConnectWithoutContext equivalent
+  uint32_t ConnectWithoutContext (std::string const &path, CallbackBase const &cb) const
+  {
+    CompiledPath c = Compile (path);
+    std::vector<Match> matches;
+    Resolve (c, matches);
+    uint32_t connected = 0;
+    for (uint32_t i = 0; i < matches.size (); ++i)
+      {
+        connected += matches[i].object->TraceConnectWithoutContext (matches[i].trace, cb);
+      }
+    return connected;
+  }
+
+private:
+  uint16_t TypeIndex (TypeId tid)
+  {
+    for (uint16_t t = 0; t < m_types.size (); ++t)
+      {
+        if (m_types[t] == tid)
+          {
+            return t;
+          }
+      }
+    m_types.push_back (tid);
+    return m_types.size () - 1;
+  }
+
+  // Follow the attribute / aggregation segments below the device
+  static Ptr<Object> Walk (CompiledPath const &c, Ptr<Object> object)
+  {
+    for (uint32_t i = 0; i < c.segments.size () && object != 0; ++i)
+      {
+        if (c.segments[i][0] == '$')
+          {
+            object = object->GetObject<Object> (c.segmentTypes[i]);
+            continue;
+          }
+        PointerValue ptr;
+        if (!object->GetAttributeFailSafe (c.segments[i], ptr))
+          {
+            return 0;
+          }
+        object = ptr.GetObject ();
+      }
+    return object;
+  }
+
+  static void Split (std::string const &path, std::vector<std::string> &out)
+  {
+    std::string::size_type start = 0;
+    while (start < path.size ())
+      {
+        std::string::size_type slash = path.find ('/', start);
+        if (slash == std::string::npos)
+          {
+            slash = path.size ();
+          }
+        if (slash > start)
+          {
+            out.push_back (path.substr (start, slash - start));
+          }
+        start = slash + 1;
+      }
+  }
+
+  // Decimal index of at most 9 digits, so it cannot overflow
+  static bool ParseIndex (std::string const &s, uint32_t &index)
+  {
+    if (s.empty () || s.size () > 9 || s.find_first_not_of ("0123456789") != std::string::npos)
+      {
+        return false;
+      }
+    index = std::atoi (s.c_str ());
+    return true;
+  }
+
+  // "*", "n", "a|b|c" or "[a-b]"; a range is cut at limit, the indices
+  // past it would be skipped by Resolve anyway
+  static bool ParseIndices (std::string const &s, uint32_t limit, std::vector<uint32_t> &out, bool &all)
+  {
+    if (s == "*")
+      {
+        all = true;
+        return true;
+      }
+    if (s.size () > 2 && s[0] == '[' && s[s.size () - 1] == ']')
+      {
+        std::string::size_type dash = s.find ('-');
+        if (dash == std::string::npos)
+          {
+            return false;
+          }
+        uint32_t lo;
+        uint32_t hi;
+        if (!ParseIndex (s.substr (1, dash - 1), lo)
+            || !ParseIndex (s.substr (dash + 1, s.size () - dash - 2), hi)
+            || lo > hi)
+          {
+            return false;
+          }
+        for (uint32_t i = lo; i <= hi && i < limit; ++i)
+          {
+            out.push_back (i);
+          }
+        return true;
+      }
+    std::string::size_type start = 0;
+    while (start <= s.size ())
+      {
+        std::string::size_type bar = s.find ('|', start);
+        if (bar == std::string::npos)
+          {
+            bar = s.size ();
+          }
+        uint32_t n;
+        if (!ParseIndex (s.substr (start, bar - start), n))
+          {
+            return false;
+          }
+        out.push_back (n);
+        start = bar + 1;
+      }
+    return true;
+  }
+
+  std::vector<uint32_t> m_deviceOffset;     // size GetNNodes () + 1
+  std::vector<Ptr<NetDevice> > m_devices;
+  std::vector<uint16_t> m_deviceType;       // index into m_types
+  std::vector<TypeId> m_types;
+  uint32_t m_maxDevices;                    // most devices on one node
+};
+
+} // namespace ns3
+
+#endif /* NODE_DEVICE_REGISTRY_H */
@@ -0,0 +1,537 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <glob.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <vector>
+
+// Merge the per-device captures of one run into a single time-ordered
+// pcapng file, one interface per input capture:
+//
+//   ./waf --run "scratch/pcap-merge --prefix=project2.2"
+//   ./waf --run "scratch/pcap-merge --inputs=project4-0-0.pcap,project4-1-1.pcap --output=project4.pcapng"
+//
+// Every open input keeps exactly one buffered record; a min-heap keyed on
+// (timestamp, interface) picks the next one to write.  Merging k files with
+// n records in total is O(n log k) and memory stays at one record per open
+// input, however long the captures are.
+//
+// Each open input holds a file descriptor.  The soft open file limit is
+// raised to the hard limit at startup; if there are still more inputs than
+// descriptors, they are merged in groups into temporary run files next to
+// the output (<output>.run<pass>-<n>), which are merged again until one
+// pass fits, so any number of captures can be merged.
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("PcapMerge");
+
+namespace {
+
+// pcapng block types and option codes
+const uint32_t SECTION_HEADER_BLOCK = 0x0A0D0D0A;
+const uint32_t INTERFACE_DESCRIPTION_BLOCK = 0x00000001;
+const uint32_t ENHANCED_PACKET_BLOCK = 0x00000006;
+const uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+const uint16_t OPT_ENDOFOPT = 0;
+const uint16_t IF_NAME = 2;
+
+// Descriptors kept free of inputs: stdio, the output, a run file, spares
+const uint32_t FD_MARGIN = 16;
+// Never open more inputs than this at once, whatever the limit
+const uint32_t MAX_FAN_IN = 65536;
+
+// An input of a merge pass: a capture, or a run file written by an
+// earlier pass.  Records of a run carry their interface id, a capture
+// is one interface.
+struct MergeSource
+{
+  std::string path;
+  bool run;
+  uint32_t iface;
+};
+
+// An open merge source and the record currently buffered from it
+struct MergeInput
+{
+  MergeInput (std::string const &path)
+    : name (path),
+      ts (0),
+      iface (0),
+      inclLen (0),
+      origLen (0)
+  {
+  }
+  virtual ~MergeInput ()
+  {
+  }
+  // Buffer the next record; false once the input is exhausted.  Records
+  // are read into the shared scratch buffer and copied into a buffer of
+  // their own size, so an input only holds what its record needs.
+  virtual bool Advance (std::vector<uint8_t> &scratch) = 0;
+
+  std::string name;
+  uint64_t ts;       // microseconds
+  uint32_t iface;
+  uint32_t inclLen;
+  uint32_t origLen;
+  std::vector<uint8_t> data;
+};
+
+struct CaptureInput : public MergeInput
+{
+  CaptureInput (std::string const &path, uint32_t id)
+    : MergeInput (path)
+  {
+    iface = id;
+    file.Open (path, std::ios::in | std::ios::binary);
+  }
+
+  virtual bool Advance (std::vector<uint8_t> &scratch)
+  {
+    uint32_t tsSec = 0;
+    uint32_t tsUsec = 0;
+    uint32_t readLen = 0;
+    inclLen = 0;
+    file.Read (&scratch[0], scratch.size (), tsSec, tsUsec, inclLen, origLen, readLen);
+    if (file.Fail ())
+      {
+        // PcapFile only fills inclLen once the record header was read, so a
+        // non-zero value means the data ended before the record did
+        if (inclLen != 0)
+          {
+            std::cerr << "Truncated record in " << name << ", skipping rest" << std::endl;
+          }
+        file.Close ();
+        data.clear ();
+        return false;
+      }
+    ts = tsSec * 1000000ULL + tsUsec;
+    data.assign (scratch.begin (), scratch.begin () + readLen);
+    inclLen = readLen;
+    return true;
+  }
+
+  PcapFile file;
+};
+
+// Run file record: iface, ts, inclLen, origLen, then inclLen data bytes,
+// in host byte order
+struct RunInput : public MergeInput
+{
+  RunInput (std::string const &path)
+    : MergeInput (path),
+      file (path.c_str (), std::ios::in | std::ios::binary)
+  {
+  }
+
+  virtual bool Advance (std::vector<uint8_t> &scratch)
+  {
+    file.read (reinterpret_cast<char *> (&iface), sizeof (iface));
+    if (!file)
+      {
+        data.clear ();
+        return false;
+      }
+    file.read (reinterpret_cast<char *> (&ts), sizeof (ts));
+    file.read (reinterpret_cast<char *> (&inclLen), sizeof (inclLen));
+    file.read (reinterpret_cast<char *> (&origLen), sizeof (origLen));
+    if (file && inclLen <= scratch.size ())
+      {
+        file.read (reinterpret_cast<char *> (&scratch[0]), inclLen);
+      }
+    if (!file || inclLen > scratch.size ())
+      {
+        std::cerr << "Truncated record in " << name << ", skipping rest" << std::endl;
+        data.clear ();
+        return false;
+      }
+    data.assign (scratch.begin (), scratch.begin () + inclLen);
+    return true;
+  }
+
+  std::ifstream file;
+};
+
+struct HeapEntry
+{
+  uint64_t ts;       // microseconds
+  uint32_t iface;
+  uint32_t input;    // index into the inputs of the current pass
+
+  // std::priority_queue is a max-heap; invert so the earliest record wins,
+  // ties broken by interface id to keep the output deterministic
+  bool operator< (const HeapEntry &o) const
+  {
+    return ts != o.ts ? ts > o.ts : iface > o.iface;
+  }
+};
+
+uint32_t
+Pad4 (uint32_t len)
+{
+  return (len + 3) & ~3u;
+}
+
+void
+Write16 (std::ostream &os, uint16_t v)
+{
+  os.write (reinterpret_cast<const char *> (&v), sizeof (v));
+}
+
+void
+Write32 (std::ostream &os, uint32_t v)
+{
+  os.write (reinterpret_cast<const char *> (&v), sizeof (v));
+}
+
+void
+WritePadded (std::ostream &os, const uint8_t *data, uint32_t len)
+{
+  static const char zeros[4] = { 0, 0, 0, 0 };
+  os.write (reinterpret_cast<const char *> (data), len);
+  os.write (zeros, Pad4 (len) - len);
+}
+
+void
+WriteSectionHeader (std::ostream &os)
+{
+  uint32_t len = 28;
+  Write32 (os, SECTION_HEADER_BLOCK);
+  Write32 (os, len);
+  Write32 (os, BYTE_ORDER_MAGIC);
+  Write16 (os, 1);              // major version
+  Write16 (os, 0);              // minor version
+  Write32 (os, 0xffffffff);     // section length unknown (-1)
+  Write32 (os, 0xffffffff);
+  Write32 (os, len);
+}
+
+void
+WriteInterfaceDescription (std::ostream &os, uint16_t linkType,
+                           uint32_t snapLen, std::string const &name)
+{
+  uint32_t nameLen = name.size ();
+  uint32_t len = 20 + 4 + Pad4 (nameLen) + 4;
+  Write32 (os, INTERFACE_DESCRIPTION_BLOCK);
+  Write32 (os, len);
+  Write16 (os, linkType);
+  Write16 (os, 0);              // reserved
+  Write32 (os, snapLen);
+  Write16 (os, IF_NAME);
+  Write16 (os, nameLen);
+  WritePadded (os, reinterpret_cast<const uint8_t *> (name.data ()), nameLen);
+  Write16 (os, OPT_ENDOFOPT);
+  Write16 (os, 0);
+  Write32 (os, len);
+}
+
+// Enhanced packet block of the buffered record, for the final pass
+void
+WriteEnhancedPacket (std::ostream &os, MergeInput const &in)
+{
+  uint32_t len = 32 + Pad4 (in.inclLen);
+  Write32 (os, ENHANCED_PACKET_BLOCK);
+  Write32 (os, len);
+  Write32 (os, in.iface);
+  Write32 (os, static_cast<uint32_t> (in.ts >> 32));
+  Write32 (os, static_cast<uint32_t> (in.ts & 0xffffffff));
+  Write32 (os, in.inclLen);
+  Write32 (os, in.origLen);
+  WritePadded (os, in.data.empty () ? 0 : &in.data[0], in.inclLen);
+  Write32 (os, len);
+}
+
+// Run file record of the buffered record, for the intermediate passes
+void
+WriteRunRecord (std::ostream &os, MergeInput const &in)
+{
+  os.write (reinterpret_cast<const char *> (&in.iface), sizeof (in.iface));
+  os.write (reinterpret_cast<const char *> (&in.ts), sizeof (in.ts));
+  os.write (reinterpret_cast<const char *> (&in.inclLen), sizeof (in.inclLen));
+  os.write (reinterpret_cast<const char *> (&in.origLen), sizeof (in.origLen));
+  if (!in.data.empty ())
+    {
+      os.write (reinterpret_cast<const char *> (&in.data[0]), in.inclLen);
+    }
+}
+
+typedef void (*RecordWriter) (std::ostream &os, MergeInput const &in);
+
+// Merge sources [first, last) into os; returns the number of records
+// written and counts the sources that could not be opened in failed
+uint64_t
+Merge (std::vector<MergeSource> const &sources, size_t first, size_t last,
+       std::ostream &os, RecordWriter write, std::vector<uint8_t> &scratch,
+       uint32_t &failed)
+{
+  std::vector<MergeInput *> in;
+  std::priority_queue<HeapEntry> heap;
+  for (size_t i = first; i < last; ++i)
+    {
+      MergeInput *m;
+      bool ok;
+      if (sources[i].run)
+        {
+          RunInput *r = new RunInput (sources[i].path);
+          ok = !r->file.fail ();
+          m = r;
+        }
+      else
+        {
+          CaptureInput *c = new CaptureInput (sources[i].path, sources[i].iface);
+          ok = !c->file.Fail ();
+          m = c;
+        }
+      if (!ok)
+        {
+          std::cerr << "Cannot read " << m->name << ", skipped" << std::endl;
+          ++failed;
+          delete m;
+          continue;
+        }
+      in.push_back (m);
+      if (m->Advance (scratch))
+        {
+          HeapEntry e = { m->ts, m->iface, static_cast<uint32_t> (in.size () - 1) };
+          heap.push (e);
+        }
+    }
+
+  uint64_t records = 0;
+  while (!heap.empty ())
+    {
+      HeapEntry e = heap.top ();
+      heap.pop ();
+      MergeInput *m = in[e.input];
+      write (os, *m);
+      ++records;
+      if (m->Advance (scratch))
+        {
+          e.ts = m->ts;
+          e.iface = m->iface;
+          heap.push (e);
+        }
+    }
+
+  for (size_t i = 0; i < in.size (); ++i)
+    {
+      delete in[i];
+    }
+  return records;
+}
+
+// Raise the soft open file limit to the hard limit; returns the soft limit
+uint32_t
+RaiseOpenFileLimit (void)
+{
+  struct rlimit rl;
+  if (getrlimit (RLIMIT_NOFILE, &rl) != 0)
+    {
+      return 256;
+    }
+  rlim_t target = std::min<rlim_t> (rl.rlim_max, MAX_FAN_IN + FD_MARGIN);
+  if (rl.rlim_cur < target)
+    {
+      struct rlimit raised = rl;
+      raised.rlim_cur = target;
+      if (setrlimit (RLIMIT_NOFILE, &raised) == 0)
+        {
+          rl = raised;
+        }
+    }
+  return std::min<rlim_t> (rl.rlim_cur, MAX_FAN_IN + FD_MARGIN);
+}
+
+void
+RemoveRuns (std::vector<MergeSource> const &sources, size_t first, size_t last)
+{
+  for (size_t i = first; i < last; ++i)
+    {
+      if (sources[i].run)
+        {
+          std::remove (sources[i].path.c_str ());
+        }
+    }
+}
+
+// Interface name for the pcapng IDB: the file name without directory and
+// extension, e.g. "project2.2-0-1" for node 0 device 1
+std::string
+InterfaceName (std::string const &path)
+{
+  std::string::size_type slash = path.find_last_of ('/');
+  std::string base = slash == std::string::npos ? path : path.substr (slash + 1);
+  std::string::size_type dot = base.rfind (".pcap");
+  return dot == std::string::npos ? base : base.substr (0, dot);
+}
+
+void
+SplitList (std::string const &list, std::vector<std::string> &out)
+{
+  std::string::size_type start = 0;
+  while (start <= list.size ())
+    {
+      std::string::size_type comma = list.find (',', start);
+      if (comma == std::string::npos)
+        {
+          comma = list.size ();
+        }
+      if (comma > start)
+        {
+          out.push_back (list.substr (start, comma - start));
+        }
+      start = comma + 1;
+    }
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  std::string prefix;
+  std::string inputs;
+  std::string output;
+
+  CommandLine cmd;
+  cmd.AddValue ("prefix", "Merge every <prefix>-<node>-<device>.pcap", prefix);
+  cmd.AddValue ("inputs", "Comma separated list of pcap files to merge", inputs);
+  cmd.AddValue ("output", "Merged pcapng file (default <prefix>-merged.pcapng)", output);
+  cmd.Parse (argc, argv);
+
+  std::vector<std::string> paths;
+  SplitList (inputs, paths);
+  if (!prefix.empty ())
+    {
+      glob_t g;
+      std::string pattern = prefix + "-*-*.pcap";
+      if (glob (pattern.c_str (), 0, 0, &g) == 0)
+        {
+          for (size_t i = 0; i < g.gl_pathc; ++i)
+            {
+              paths.push_back (g.gl_pathv[i]);
+            }
+        }
+      globfree (&g);
+    }
+  if (paths.empty ())
+    {
+      std::cerr << "No input captures, use --prefix or --inputs." << std::endl;
+      return 1;
+    }
+  if (output.empty ())
+    {
+      output = (prefix.empty () ? std::string ("merged") : prefix) + "-merged.pcapng";
+    }
+
+  uint32_t limit = RaiseOpenFileLimit ();
+  size_t fanIn = limit > FD_MARGIN + 2 ? limit - FD_MARGIN : 2;
+
+  std::ofstream os (output.c_str (), std::ios::out | std::ios::binary);
+  if (!os)
+    {
+      std::cerr << "Cannot open " << output << std::endl;
+      return 1;
+    }
+  WriteSectionHeader (os);
+
+  // pcapng requires every interface to be described before its first
+  // packet, so read every capture header and emit the IDBs up front; the
+  // captures are closed again until their pass
+  std::vector<MergeSource> sources;
+  std::vector<uint8_t> scratch (1);
+  uint32_t skipped = 0;
+  for (size_t i = 0; i < paths.size (); ++i)
+    {
+      PcapFile file;
+      file.Open (paths[i], std::ios::in | std::ios::binary);
+      if (file.Fail ())
+        {
+          std::cerr << "Cannot read " << paths[i] << ", skipped" << std::endl;
+          ++skipped;
+          continue;
+        }
+      scratch.resize (std::max<size_t> (scratch.size (), file.GetSnapLen ()));
+      WriteInterfaceDescription (os, file.GetDataLinkType (),
+                                 file.GetSnapLen (), InterfaceName (paths[i]));
+      file.Close ();
+      MergeSource s = { paths[i], false, static_cast<uint32_t> (sources.size ()) };
+      sources.push_back (s);
+    }
+  uint32_t captures = sources.size ();
+
+  // More inputs than descriptors: merge groups of fanIn into run files,
+  // which the next pass merges in turn
+  for (uint32_t pass = 0; sources.size () > fanIn; ++pass)
+    {
+      NS_LOG_INFO ("pass " << pass << ": " << sources.size () << " inputs, "
+                   << fanIn << " per group");
+      std::vector<MergeSource> next;
+      for (size_t first = 0; first < sources.size (); first += fanIn)
+        {
+          size_t last = std::min (first + fanIn, sources.size ());
+          std::ostringstream name;
+          name << output << ".run" << pass << "-" << next.size ();
+          MergeSource run = { name.str (), true, 0 };
+          std::ofstream rs (run.path.c_str (), std::ios::out | std::ios::binary);
+          if (rs)
+            {
+              Merge (sources, first, last, rs, &WriteRunRecord, scratch, skipped);
+              rs.close ();
+            }
+          RemoveRuns (sources, first, last);
+          if (!rs)
+            {
+              std::cerr << "Cannot write " << run.path << std::endl;
+              std::remove (run.path.c_str ());
+              RemoveRuns (sources, last, sources.size ());
+              RemoveRuns (next, 0, next.size ());
+              return 1;
+            }
+          next.push_back (run);
+        }
+      sources.swap (next);
+    }
+
+  uint64_t records = Merge (sources, 0, sources.size (), os,
+                            &WriteEnhancedPacket, scratch, skipped);
+  RemoveRuns (sources, 0, sources.size ());
+  os.close ();
+  if (!os)
+    {
+      std::cerr << "Cannot write " << output << std::endl;
+      return 1;
+    }
+
+  std::cout << "Merged " << records << " records from " << captures
+            << " captures into " << output << std::endl;
+  if (skipped > 0)
+    {
+      std::cerr << skipped << " inputs could not be read, merge is incomplete" << std::endl;
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,195 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PHILOX_RANDOM_VARIABLE_H
+#define PHILOX_RANDOM_VARIABLE_H
+
+#include "ns3/core-module.h"
+
+namespace ns3 {
+
+/**
+ * Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+ * numbers: as easy as 1, 2, 3", SC 2011): 128-bit counter and 64-bit key in,
+ * four 32-bit outputs out.
+ */
+class Philox4x32
+{
+public:
+  static void Block (uint32_t const ctr[4], uint32_t const key[2], uint32_t out[4])
+  {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round)
+      {
+        uint64_t p0 = uint64_t (0xD2511F53) * c0;
+        uint64_t p1 = uint64_t (0xCD9E8D57) * c2;
+        uint32_t n0 = uint32_t (p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = uint32_t (p0 >> 32) ^ c3 ^ k1;
+        c1 = uint32_t (p1);
+        c3 = uint32_t (p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+      }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+};
+
+/**
+ * Uniform random variable backed by Philox4x32 instead of an
+ * MRG32k3a substream.
+ *
+ * The n-th draw is a pure function of (Key, Purpose, global seed and run,
+ * n): nothing is shared between variables and there is no state to
+ * advance, so the value an object sees does not depend on how many other
+ * objects exist, in which order they draw or on which thread.  Use the
+ * node or object id as Key and a different Purpose for every quantity the
+ * object draws (e.g. speed and direction).
+ *
+ * Each Philox block yields four 32-bit outputs, one double each.
+ *
+ * The RandomVariableStream base class still sets up its own MRG32k3a
+ * RngStream (the "Stream" attribute) for every instance, unused here, so
+ * this does not remove the per-object seeding cost of ns-3's generator.
+ * Pass the variables when the owning model is constructed, otherwise the
+ * model's default variables are seeded as well.
+ */
+class PhiloxUniformRandomVariable : public RandomVariableStream
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::PhiloxUniformRandomVariable")
+      .SetParent<RandomVariableStream> ()
+      .AddConstructor<PhiloxUniformRandomVariable> ()
+      .AddAttribute ("Min", "The lower bound on the values returned by this RNG stream.",
+                     DoubleValue (0),
+                     MakeDoubleAccessor (&PhiloxUniformRandomVariable::m_min),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("Max", "The upper bound on the values returned by this RNG stream.",
+                     DoubleValue (1.0),
+                     MakeDoubleAccessor (&PhiloxUniformRandomVariable::m_max),
+                     MakeDoubleChecker<double> ())
+      .AddAttribute ("Key", "Identity of the drawing object, usually the node id.",
+                     UintegerValue (0),
+                     MakeUintegerAccessor (&PhiloxUniformRandomVariable::m_key),
+                     MakeUintegerChecker<uint32_t> ())
+      .AddAttribute ("Purpose", "Separates the quantities drawn by one object.",
+                     UintegerValue (0),
+                     MakeUintegerAccessor (&PhiloxUniformRandomVariable::m_purpose),
+                     MakeUintegerChecker<uint32_t> ())
+    ;
+    return tid;
+  }
+
+  PhiloxUniformRandomVariable ()
+    : m_min (0),
+      m_max (1.0),
+      m_key (0),
+      m_purpose (0),
+      m_counter (0),
+      m_used (4)
+  {
+  }
+
+  double GetMin (void) const
+  {
+    return m_min;
+  }
+  double GetMax (void) const
+  {
+    return m_max;
+  }
+
+  // Position of the next draw; draws depend only on this, not on history
+  uint64_t GetCounter (void) const
+  {
+    return m_counter;
+  }
+
+  double GetValue (double min, double max)
+  {
+    double v = min + Uniform01 (Next ()) * (max - min);
+    if (IsAntithetic ())
+      {
+        v = min + (max - v);
+      }
+    return v;
+  }
+  uint32_t GetInteger (uint32_t min, uint32_t max)
+  {
+    NS_ASSERT (min <= max);
+    return static_cast<uint32_t> (GetValue (min, max + 1.0));
+  }
+
+  virtual double GetValue (void)
+  {
+    return GetValue (m_min, m_max);
+  }
+  virtual uint32_t GetInteger (void)
+  {
+    return GetInteger (static_cast<uint32_t> (m_min), static_cast<uint32_t> (m_max));
+  }
+
+private:
+  // 32-bit output to (0, 1), never exactly 0 or 1
+  static double Uniform01 (uint32_t x)
+  {
+    return (x + 0.5) * (1.0 / 4294967296.0);
+  }
+
+  void MakeKey (uint32_t key[2]) const
+  {
+    key[0] = m_key;
+    key[1] = RngSeedManager::GetSeed ();
+  }
+
+  uint32_t Next (void)
+  {
+    if (m_used == 4)
+      {
+        // counter: block index, Purpose, run number
+        uint64_t block = m_counter / 4;
+        uint32_t ctr[4] = { uint32_t (block), uint32_t (block >> 32), m_purpose,
+                            static_cast<uint32_t> (RngSeedManager::GetRun ()) };
+        uint32_t key[2];
+        MakeKey (key);
+        Philox4x32::Block (ctr, key, m_block);
+        m_used = 0;
+      }
+    ++m_counter;
+    return m_block[m_used++];
+  }
+
+  double m_min;
+  double m_max;
+  uint32_t m_key;
+  uint32_t m_purpose;
+  uint64_t m_counter;   // draws made so far, block index is m_counter / 4
+  uint32_t m_block[4];
+  uint32_t m_used;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (PhiloxUniformRandomVariable);
+
+} // namespace ns3
+
+#endif /* PHILOX_RANDOM_VARIABLE_H */
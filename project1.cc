@@ -15,6 +15,7 @@
  */
 
 #include "ns3/core-module.h"
+#include "scenario-bench.h"
 
 #include <iostream>
 
@@ -39,15 +40,20 @@ main (int argc, char *argv[])
 	CommandLine cmd;
 	std::string name;
 	std::string num;
-	int freq;
+	int freq = 10;
+	ScenarioBench bench;
 	cmd.AddValue ("name", "my name ", name);
     cmd.AddValue ("num", "my number ", num);
 	cmd.AddValue ("freq", "the frequency", freq);
+	bench.AddCommandLine (cmd);
 	cmd.Parse(argc,argv);
+	bench.Start ();
 
 	printHello(name,num);
 
 	Simulator::Stop(Seconds(freq));
 	Simulator::Run ();
+	int status = bench.Finish ("project1", 0);
 	Simulator::Destroy ();
+	return status;
 }
@@ -22,10 +22,16 @@
 #include "ns3/mobility-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/internet-module.h"
+#include "scenario-bench.h"
+#include "slim-stack-helper.h"
+#include "static-arp.h"
+#include "batch-udp-echo-server.h"
+
+#include <cmath>
 
 // Default Network Topology
 //默认网络拓扑
-// Number of wifi or csma nodes can be increased up to 250
+// Number of wifi or csma nodes can be increased up to 250 (65000 on a /16)
 //                          |
 //                 Rank 0   |   Rank 1
 // -------------------------|----------------------------
@@ -49,28 +55,52 @@ main (int argc, char *argv[])
   bool verbose = true;
   uint32_t nWifi = 3;				//wifi节点数量
    bool tracing = false;
+  bool batchEcho = false;
+  bool staticArp = false;
+  bool slimStack = false;
 
 
   CommandLine cmd;
   cmd.AddValue ("nWifi", "Number of wifi STA devices", nWifi);
   cmd.AddValue ("verbose", "Tell echo applications to log if true", verbose);
   cmd.AddValue ("tracing", "Enable pcap tracing", tracing);
+  cmd.AddValue ("batchEcho", "Echo all datagrams arriving at the same time in one batch", batchEcho);
+  cmd.AddValue ("staticArp", "Pre-populate ARP caches instead of resolving at run time", staticArp);
+  cmd.AddValue ("slimStack", "Install only IPv4, ARP, ICMPv4 and UDP on the STAs", slimStack);
+  ScenarioBench bench;
+  bench.AddCommandLine (cmd);
 
   cmd.Parse (argc,argv);
+  bench.Start ();
 
   // Check for valid number of csma or wifi nodes
   // 250 should be enough, otherwise IP addresses 
   // soon become an issue		//判断是否超过了250个，超过报错 , 原因？
-  if (nWifi > 250 )
+  // Larger cells (benchmark runs) are addressed from a /16 instead
+  if (nWifi > 65000 )
     {
-      std::cout << "Too many wifi or csma nodes, no more than 250 each." << std::endl;
+      std::cout << "Too many wifi or csma nodes, no more than 65000 each." << std::endl;
       return 1;
     }
+  bool wideLan = nWifi > 250;
+
+  // Beyond 15 STAs the 3-wide grid runs out of radio range, spread big
+  // cells over a square grid covering 100m x 50m instead
+  uint32_t gridWidth = 3;
+  double deltaX = 5.0;
+  double deltaY = 10.0;
+  if (nWifi > 15)
+    {
+      gridWidth = static_cast<uint32_t> (std::ceil (std::sqrt (double (nWifi))));
+      deltaX = 100.0 / gridWidth;
+      deltaY = 50.0 / gridWidth;
+    }
 
   if (verbose)
     {
       LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
       LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);	//启动记录组件
+      LogComponentEnable ("BatchUdpEchoServerApplication", LOG_LEVEL_INFO);
     }
 
 
@@ -130,9 +160,9 @@ main (int argc, char *argv[])
   mobility1.SetPositionAllocator ("ns3::GridPositionAllocator",
                                  "MinX", DoubleValue (0.0),
                                  "MinY", DoubleValue (0.0),
-                                 "DeltaX", DoubleValue (5.0),
-                                 "DeltaY", DoubleValue (10.0),
-                                 "GridWidth", UintegerValue (3),
+                                 "DeltaX", DoubleValue (deltaX),
+                                 "DeltaY", DoubleValue (deltaY),
+                                 "GridWidth", UintegerValue (gridWidth),
                                  "LayoutType", StringValue ("RowFirst"));
 
   //配置STA移动方式，RandomWalk2dMobilityModel，随机游走模型
@@ -182,9 +212,9 @@ mob->SetVelocity(Vector(5,0,0));
   mobility2.SetPositionAllocator ("ns3::GridPositionAllocator",
                                  "MinX", DoubleValue (0.0),
                                  "MinY", DoubleValue (0.0),
-                                 "DeltaX", DoubleValue (5.0),
-                                 "DeltaY", DoubleValue (10.0),
-                                 "GridWidth", UintegerValue (3),
+                                 "DeltaX", DoubleValue (deltaX),
+                                 "DeltaY", DoubleValue (deltaY),
+                                 "GridWidth", UintegerValue (gridWidth),
                                  "LayoutType", StringValue ("RowFirst"));
 
   //配置STA移动方式，RandomWalk2dMobilityModel，随机游走模型
@@ -200,11 +230,27 @@ mob->SetVelocity(Vector(10,0,0));
   mobility2.Install (wifiApNode2);
 
   //已经创建了节点，设备，信道和移动模型，接下来配置协议栈
+  //STA只运行UDP echo客户端，slimStack时只安装IPv4/ARP/ICMPv4/UDP，AP保留完整协议栈
   InternetStackHelper stack;
+  SlimStackHelper slimStackHelper;
   stack.Install (wifiApNode1);
-  stack.Install (wifiStaNodes1);
+  if (slimStack)
+    {
+      slimStackHelper.Install (wifiStaNodes1);
+    }
+  else
+    {
+      stack.Install (wifiStaNodes1);
+    }
   stack.Install (wifiApNode2);
-  stack.Install (wifiStaNodes2);
+  if (slimStack)
+    {
+      slimStackHelper.Install (wifiStaNodes2);
+    }
+  else
+    {
+      stack.Install (wifiStaNodes2);
+    }
 
   //分配IP地址
   Ipv4AddressHelper address;
@@ -213,17 +259,40 @@ mob->SetVelocity(Vector(10,0,0));
   Ipv4InterfaceContainer p2pInterfaces;
   p2pInterfaces = address.Assign (p2pDevices);
  //wifi信道
-  address.SetBase ("10.1.3.0", "255.255.255.0");
+  if (wideLan)
+    {
+      address.SetBase ("10.3.0.0", "255.255.0.0");
+    }
+  else
+    {
+      address.SetBase ("10.1.3.0", "255.255.255.0");
+    }
   address.Assign (staDevices1);
   address.Assign (apDevices1);
-  address.SetBase ("10.1.2.0", "255.255.255.0");
+  if (wideLan)
+    {
+      address.SetBase ("10.2.0.0", "255.255.0.0");
+    }
+  else
+    {
+      address.SetBase ("10.1.2.0", "255.255.255.0");
+    }
   address.Assign (staDevices2);
   address.Assign (apDevices2);
 
+  //预先填好所有ARP缓存，第一个echo包不用再等ARP应答
+  if (staticArp)
+    {
+      PopulateArpCache ();
+    }
+
   //放置echo服务端程序在最右边的csma节点,端口为9
   UdpEchoServerHelper echoServer (9);
+  //batchEcho时同一时刻到达的包在一次回调中统一回显
+  BatchUdpEchoServerHelper batchEchoServer (9);
 
-  ApplicationContainer serverApps = echoServer.Install (p2pNodes.Get (0));
+  ApplicationContainer serverApps = batchEcho ?
+    batchEchoServer.Install (p2pNodes.Get (0)) : echoServer.Install (p2pNodes.Get (0));
   serverApps.Start (Seconds (1.0));
   serverApps.Stop (Seconds (10.0));
 
@@ -268,12 +337,17 @@ mob->SetVelocity(Vector(10,0,0));
   Simulator::Stop (Seconds (10.0));
 
 
+  //基准测试时不写trace文件
+  if (!bench.IsEnabled ())
+    {
       pointToPoint.EnablePcapAll ("project2.2",false);
       phy1.EnablePcap ("project2.2", apDevices1.Get (0));
       phy2.EnablePcap ("project2.2", apDevices2.Get (0), true);
+    }
   
 
   Simulator::Run ();
+  int status = bench.Finish ("project2.2", nWifi);
   Simulator::Destroy ();
-  return 0;
+  return status;
 }
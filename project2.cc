@@ -21,10 +21,15 @@
 #include "ns3/mobility-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/internet-module.h"
+#include "scenario-bench.h"
+#include "static-arp.h"
+#include "batch-udp-echo-server.h"
+
+#include <algorithm>
 
 // Default Network Topology
 //默认网络拓扑
-// Number of wifi or csma nodes can be increased up to 250
+// Number of wifi or csma nodes can be increased up to 250 (65000 on a /16)
 //                          |
 //                 Rank 0   |   Rank 1
 // -------------------------|----------------------------
@@ -47,6 +52,8 @@ main (int argc, char *argv[])
   uint32_t nCsma1 = 2;	
  uint32_t nCsma2 = 3;			//csma节点数量
    bool tracing = false;
+  bool batchEcho = false;
+  bool staticArp = false;
 
 
   CommandLine cmd;
@@ -54,22 +61,30 @@ main (int argc, char *argv[])
  cmd.AddValue ("nCsma2", "Number of \"extra\" CSMA nodes/devices", nCsma2);
   cmd.AddValue ("verbose", "Tell echo applications to log if true", verbose);
   cmd.AddValue ("tracing", "Enable pcap tracing", tracing);
+  cmd.AddValue ("batchEcho", "Echo all datagrams arriving at the same time in one batch", batchEcho);
+  cmd.AddValue ("staticArp", "Pre-populate ARP caches instead of resolving at run time", staticArp);
+  ScenarioBench bench;
+  bench.AddCommandLine (cmd);
 
   cmd.Parse (argc,argv);
+  bench.Start ();
 
   // Check for valid number of csma or wifi nodes
   // 250 should be enough, otherwise IP addresses 
   // soon become an issue		//判断是否超过了250个，超过报错 , 原因？
-  if (nCsma1 > 250||nCsma2>250)
+  // Larger LANs (benchmark runs) are addressed from a /16 instead
+  if (nCsma1 > 65000||nCsma2>65000)
     {
-      std::cout << "Too many wifi or csma nodes, no more than 250 each." << std::endl;
+      std::cout << "Too many wifi or csma nodes, no more than 65000 each." << std::endl;
       return 1;
     }
+  bool wideLan = nCsma1 > 250 || nCsma2 > 250;
 
   if (verbose)
     {
       LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
       LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);	//启动记录组件
+      LogComponentEnable ("BatchUdpEchoServerApplication", LOG_LEVEL_INFO);
     }
  //创建2个节点，p2p链路两端
   NodeContainer p2pNodes;
@@ -123,17 +138,40 @@ main (int argc, char *argv[])
   Ipv4InterfaceContainer p2pInterfaces;
   p2pInterfaces = address.Assign (p2pDevices);
  //csma信道
-  address.SetBase ("10.1.2.0", "255.255.255.0");
+  if (wideLan)
+    {
+      address.SetBase ("10.2.0.0", "255.255.0.0");
+    }
+  else
+    {
+      address.SetBase ("10.1.2.0", "255.255.255.0");
+    }
   Ipv4InterfaceContainer csmaInterfaces1;
   csmaInterfaces1 = address.Assign (csmaDevices1);
  //csma信道
-  address.SetBase ("10.1.3.0", "255.255.255.0");
+  if (wideLan)
+    {
+      address.SetBase ("10.3.0.0", "255.255.0.0");
+    }
+  else
+    {
+      address.SetBase ("10.1.3.0", "255.255.255.0");
+    }
   Ipv4InterfaceContainer csmaInterfaces2;
   csmaInterfaces2 = address.Assign (csmaDevices2);
+
+  //预先填好所有ARP缓存，第一个echo包不用再等ARP应答
+  if (staticArp)
+    {
+      PopulateArpCache ();
+    }
 //放置echo服务端程序在最右边的csma节点,端口为9
   UdpEchoServerHelper echoServer (9);
+  //batchEcho时同一时刻到达的包在一次回调中统一回显
+  BatchUdpEchoServerHelper batchEchoServer (9);
 
-  ApplicationContainer serverApps = echoServer.Install (csmaNodes1.Get (nCsma1));
+  ApplicationContainer serverApps = batchEcho ?
+    batchEchoServer.Install (csmaNodes1.Get (nCsma1)) : echoServer.Install (csmaNodes1.Get (nCsma1));
   serverApps.Start (Seconds (1.0));
   serverApps.Stop (Seconds (10.0));
 
@@ -194,7 +232,8 @@ main (int argc, char *argv[])
     }
 
   Simulator::Run ();
+  int status = bench.Finish ("project2", std::max (nCsma1, nCsma2));
   Simulator::Destroy ();
-  return 0;
+  return status;
 }
 
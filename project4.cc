@@ -22,10 +22,18 @@
 #include "ns3/mobility-module.h"
 #include "ns3/csma-module.h"
 #include "ns3/internet-module.h"
+#include "scenario-bench.h"
+#include "slim-stack-helper.h"
+#include "static-arp.h"
+#include "batch-udp-echo-server.h"
+#include "node-device-registry.h"
+#include "philox-random-variable.h"
+
+#include <cmath>
 
 // Default Network Topology
 //默认网络拓扑
-// Number of wifi or csma nodes can be increased up to 250
+// Number of wifi or csma nodes can be increased up to 250 (65000 on a /16)
 //                          |
 //                 Rank 0   |   Rank 1
 // -------------------------|----------------------------
@@ -43,34 +51,97 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("ThirdScriptExample");		//定义记录组件
 
+//随机游走的速度和方向改用以节点ID为key的Philox计数器随机数，
+//每个节点的取值与节点数量、创建和调度顺序无关。
+//Philox变量在构造模型时直接传入，不会先创建默认的UniformRandomVariable
+static void
+InstallPhiloxRandomWalk (MobilityHelper &mobility, NodeContainer nodes, Rectangle bounds)
+{
+  for (uint32_t i = 0; i < nodes.GetN (); ++i)
+    {
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<PhiloxUniformRandomVariable> speed = CreateObjectWithAttributes<PhiloxUniformRandomVariable> (
+          "Key", UintegerValue (node->GetId ()),
+          "Purpose", UintegerValue (0),
+          "Min", DoubleValue (2.0),
+          "Max", DoubleValue (4.0));
+      Ptr<PhiloxUniformRandomVariable> direction = CreateObjectWithAttributes<PhiloxUniformRandomVariable> (
+          "Key", UintegerValue (node->GetId ()),
+          "Purpose", UintegerValue (1),
+          "Min", DoubleValue (0.0),
+          "Max", DoubleValue (6.283184));
+      mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                 "Bounds", RectangleValue (bounds),
+                                 "Speed", PointerValue (speed),
+                                 "Direction", PointerValue (direction));
+      //逐个安装，位置仍按网格分配器的顺序取
+      mobility.Install (node);
+    }
+}
+
+//统计每个节点wifi物理层收到的帧数
+static void
+CountPhyRx (uint64_t *count, Ptr<const Packet> packet)
+{
+  ++*count;
+}
+
 int 
 main (int argc, char *argv[])
 {
   bool verbose = true;
   uint32_t nWifi = 6;				//wifi节点数量
    bool tracing = false;
+  bool staticArp = false;
+  bool batchEcho = false;
+  bool philoxRng = false;
+  bool rxStats = false;
+  bool slimStack = false;
 
 
   CommandLine cmd;
   cmd.AddValue ("nWifi", "Number of wifi STA devices", nWifi);
   cmd.AddValue ("verbose", "Tell echo applications to log if true", verbose);
   cmd.AddValue ("tracing", "Enable pcap tracing", tracing);
+  cmd.AddValue ("staticArp", "Pre-populate ARP caches instead of resolving at run time", staticArp);
+  cmd.AddValue ("batchEcho", "Echo all datagrams arriving at the same time in one batch", batchEcho);
+  cmd.AddValue ("philoxRng", "Draw STA random walks from per-node Philox streams", philoxRng);
+  cmd.AddValue ("rxStats", "Print the frames received by every node's wifi PHY", rxStats);
+  cmd.AddValue ("slimStack", "Install only IPv4, ARP, ICMPv4 and UDP on the STAs", slimStack);
+  ScenarioBench bench;
+  bench.AddCommandLine (cmd);
 
   cmd.Parse (argc,argv);
+  bench.Start ();
 
   // Check for valid number of csma or wifi nodes
   // 250 should be enough, otherwise IP addresses 
   // soon become an issue		//判断是否超过了250个，超过报错 , 原因？
-  if (nWifi > 250 )
+  // Larger cells (benchmark runs) are addressed from a /16 instead
+  if (nWifi > 65000 )
     {
-      std::cout << "Too many wifi or csma nodes, no more than 250 each." << std::endl;
+      std::cout << "Too many wifi or csma nodes, no more than 65000 each." << std::endl;
       return 1;
     }
+  bool wideLan = nWifi > 250;
+
+  // Beyond 15 STAs the 3-wide grid leaves the walk bounds and radio range,
+  // spread big cells over a square grid of the same 100m x 50m area
+  uint32_t gridWidth = 3;
+  double deltaX = 5.0;
+  double deltaY = 10.0;
+  if (nWifi > 15)
+    {
+      gridWidth = static_cast<uint32_t> (std::ceil (std::sqrt (double (nWifi))));
+      deltaX = 100.0 / gridWidth;
+      deltaY = 50.0 / gridWidth;
+    }
 
   if (verbose)
     {
       LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
       LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);	//启动记录组件
+      LogComponentEnable ("BatchUdpEchoServerApplication", LOG_LEVEL_INFO);
     }
 
 
@@ -129,15 +200,22 @@ main (int argc, char *argv[])
   mobility1.SetPositionAllocator ("ns3::GridPositionAllocator",
                                  "MinX", DoubleValue (0.0),
                                  "MinY", DoubleValue (0.0),
-                                 "DeltaX", DoubleValue (5.0),
-                                 "DeltaY", DoubleValue (10.0),
-                                 "GridWidth", UintegerValue (3),
+                                 "DeltaX", DoubleValue (deltaX),
+                                 "DeltaY", DoubleValue (deltaY),
+                                 "GridWidth", UintegerValue (gridWidth),
                                  "LayoutType", StringValue ("RowFirst"));
 
   //配置STA移动方式，RandomWalk2dMobilityModel，随机游走模型
-  mobility1.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Bounds", RectangleValue (Rectangle (0, 100, -50, 50)));
-  mobility1.Install (wifiStaNodes1);
+  if (philoxRng)
+    {
+      InstallPhiloxRandomWalk (mobility1, wifiStaNodes1, Rectangle (0, 100, -50, 50));
+    }
+  else
+    {
+      mobility1.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                 "Bounds", RectangleValue (Rectangle (0, 100, -50, 50)));
+      mobility1.Install (wifiStaNodes1);
+    }
    Ptr<RandomWalk2dMobilityModel>mob1=wifiStaNodes1.Get(0)->GetObject<RandomWalk2dMobilityModel>();
 mob1->SetPosition(Vector(0,10,0));
    Ptr<RandomWalk2dMobilityModel>mob2=wifiStaNodes1.Get(1)->GetObject<RandomWalk2dMobilityModel>();
@@ -190,15 +268,22 @@ mob8->SetPosition(Vector(10,10,0));
   mobility2.SetPositionAllocator ("ns3::GridPositionAllocator",
                                  "MinX", DoubleValue (0.0),
                                  "MinY", DoubleValue (0.0),
-                                 "DeltaX", DoubleValue (5.0),
-                                 "DeltaY", DoubleValue (10.0),
-                                 "GridWidth", UintegerValue (3),
+                                 "DeltaX", DoubleValue (deltaX),
+                                 "DeltaY", DoubleValue (deltaY),
+                                 "GridWidth", UintegerValue (gridWidth),
                                  "LayoutType", StringValue ("RowFirst"));
 
   //配置STA移动方式，RandomWalk2dMobilityModel，随机游走模型
-  mobility2.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
-                             "Bounds", RectangleValue (Rectangle (0, 100, -50, 50)));
-  mobility2.Install (wifiStaNodes2);
+  if (philoxRng)
+    {
+      InstallPhiloxRandomWalk (mobility2, wifiStaNodes2, Rectangle (0, 100, -50, 50));
+    }
+  else
+    {
+      mobility2.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                 "Bounds", RectangleValue (Rectangle (0, 100, -50, 50)));
+      mobility2.Install (wifiStaNodes2);
+    }
   Ptr<RandomWalk2dMobilityModel>mob9=wifiStaNodes2.Get(0)->GetObject<RandomWalk2dMobilityModel>();
 mob9->SetPosition(Vector(50,10,0));
    Ptr<RandomWalk2dMobilityModel>mob10=wifiStaNodes2.Get(1)->GetObject<RandomWalk2dMobilityModel>();
@@ -217,11 +302,27 @@ mob14->SetPosition(Vector(65,2,0));
    Ptr<ConstantPositionMobilityModel>mob7=wifiApNode2.Get(0)->GetObject<ConstantPositionMobilityModel>();
 mob7->SetPosition(Vector(60,10,0));
   //已经创建了节点，设备，信道和移动模型，接下来配置协议栈
+  //STA只运行UDP echo客户端，slimStack时只安装IPv4/ARP/ICMPv4/UDP，AP保留完整协议栈
   InternetStackHelper stack;
+  SlimStackHelper slimStackHelper;
   stack.Install (wifiApNode1);
-  stack.Install (wifiStaNodes1);
+  if (slimStack)
+    {
+      slimStackHelper.Install (wifiStaNodes1);
+    }
+  else
+    {
+      stack.Install (wifiStaNodes1);
+    }
   stack.Install (wifiApNode2);
-  stack.Install (wifiStaNodes2);
+  if (slimStack)
+    {
+      slimStackHelper.Install (wifiStaNodes2);
+    }
+  else
+    {
+      stack.Install (wifiStaNodes2);
+    }
 
   //分配IP地址
   Ipv4AddressHelper address;
@@ -230,17 +331,40 @@ mob7->SetPosition(Vector(60,10,0));
   Ipv4InterfaceContainer p2pInterfaces;
   p2pInterfaces = address.Assign (p2pDevices);
  //wifi信道
-  address.SetBase ("10.1.3.0", "255.255.255.0");
+  if (wideLan)
+    {
+      address.SetBase ("10.3.0.0", "255.255.0.0");
+    }
+  else
+    {
+      address.SetBase ("10.1.3.0", "255.255.255.0");
+    }
   address.Assign (staDevices1);
   address.Assign (apDevices1);
-  address.SetBase ("10.1.2.0", "255.255.255.0");
+  if (wideLan)
+    {
+      address.SetBase ("10.2.0.0", "255.255.0.0");
+    }
+  else
+    {
+      address.SetBase ("10.1.2.0", "255.255.255.0");
+    }
   address.Assign (staDevices2);
   address.Assign (apDevices2);
 
+  //预先填好所有ARP缓存，第一个echo包不用再等ARP应答
+  if (staticArp)
+    {
+      PopulateArpCache ();
+    }
+
   //放置echo服务端程序在最右边的csma节点,端口为9
   UdpEchoServerHelper echoServer (9);
+  //batchEcho时同一时刻到达的包在一次回调中统一回显
+  BatchUdpEchoServerHelper batchEchoServer (9);
 
-  ApplicationContainer serverApps = echoServer.Install (p2pNodes.Get (0));
+  ApplicationContainer serverApps = batchEcho ?
+    batchEchoServer.Install (p2pNodes.Get (0)) : echoServer.Install (p2pNodes.Get (0));
   serverApps.Start (Seconds (1.0));
   serverApps.Stop (Seconds (10.0));
 
@@ -261,6 +385,9 @@ mob7->SetPosition(Vector(60,10,0));
   Simulator::Stop (Seconds (10.0));
 
 
+  //基准测试时不写trace文件
+  if (!bench.IsEnabled ())
+    {
       pointToPoint.EnablePcapAll ("project4",false);
       phy1.EnablePcap ("project4", apDevices1.Get (0));
       phy2.EnablePcap ("project4", apDevices2.Get (0), true);
@@ -269,9 +396,35 @@ AsciiTraceHelper ascii1;
 pointToPoint.EnableAsciiAll(ascii1.CreateFileStream("project4p2p.tr"));
 AsciiTraceHelper ascii2;
 phy1.EnableAsciiAll(ascii2.CreateFileStream("project4wifi.tr"));
+    }
+
+  //通过索引注册表连接所有wifi设备的PhyRxEnd，不走Config的对象图遍历
+  std::vector<uint64_t> rxCount (NodeList::GetNNodes (), 0);
+  if (rxStats)
+    {
+      NodeDeviceRegistry registry;
+      registry.Build ();
+      NodeDeviceRegistry::CompiledPath path =
+        registry.Compile ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyRxEnd");
+      std::vector<NodeDeviceRegistry::Match> matches;
+      registry.Resolve (path, matches);
+      for (uint32_t i = 0; i < matches.size (); ++i)
+        {
+          matches[i].object->TraceConnectWithoutContext (matches[i].trace,
+                                                         MakeBoundCallback (&CountPhyRx, &rxCount[matches[i].node]));
+        }
+    }
   
 
   Simulator::Run ();
+  if (rxStats)
+    {
+      for (uint32_t n = 0; n < rxCount.size (); ++n)
+        {
+          std::cout << "node " << n << " wifi rx " << rxCount[n] << std::endl;
+        }
+    }
+  int status = bench.Finish ("project4", nWifi);
   Simulator::Destroy ();
-  return 0;
+  return status;
 }
@@ -0,0 +1,312 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SCENARIO_BENCH_H
+#define SCENARIO_BENCH_H
+
+// Benchmark mode shared by the project scenario programs.  A scenario adds
+// the options with ScenarioBench::AddCommandLine, calls Start () right after
+// cmd.Parse () and Finish () right after Simulator::Run ().  Finish () reports
+//
+//   wall time, events/sec, peak RSS and heap allocations per event
+//
+// and compares them against the stored baseline for the same scenario and
+// node count (bench-baselines.txt by default).  bench.sh runs the node
+// scenarios at 10, 100 and 1000 nodes.
+//
+// Wall time and events/sec only count as regressed when the run is also
+// --minWall (default 50 ms) slower than the baseline, so timer noise on
+// short runs does not fail the comparison.
+//
+// This header replaces the global operator new to count allocations, so it
+// must be included by exactly one translation unit of a program.  The
+// replacement is compiled in unconditionally: every allocation of the
+// program pays one counter increment, with or without --bench.
+
+#include "ns3/core-module.h"
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+namespace ns3 {
+
+// Heap allocations made through operator new since program start
+static uint64_t g_benchAllocations = 0;
+
+/**
+ * MapScheduler (the default ns-3 scheduler) that also counts the events
+ * handed to the simulator, cancelled ones included.
+ */
+class CountingMapScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CountingMapScheduler")
+      .SetParent<MapScheduler> ()
+      .AddConstructor<CountingMapScheduler> ()
+    ;
+    return tid;
+  }
+
+  virtual Event RemoveNext (void)
+  {
+    ++Count ();
+    return MapScheduler::RemoveNext ();
+  }
+
+  static uint64_t &Count (void)
+  {
+    static uint64_t count = 0;
+    return count;
+  }
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CountingMapScheduler);
+
+class ScenarioBench
+{
+public:
+  ScenarioBench ()
+    : m_enabled (false),
+      m_seed (1),
+      m_baseline ("bench-baselines.txt"),
+      m_tolerance (0.10),
+      m_minWall (0.05),
+      m_update (false),
+      m_events (0),
+      m_allocations (0)
+  {
+  }
+
+  void AddCommandLine (CommandLine &cmd)
+  {
+    cmd.AddValue ("bench", "Run as a benchmark and compare against the baseline", m_enabled);
+    cmd.AddValue ("seed", "RNG seed of benchmark runs", m_seed);
+    cmd.AddValue ("baseline", "Benchmark baseline file", m_baseline);
+    cmd.AddValue ("tolerance", "Allowed relative regression against the baseline", m_tolerance);
+    cmd.AddValue ("minWall", "Wall time difference in seconds below which timing is not compared", m_minWall);
+    cmd.AddValue ("updateBaseline", "Store this run as the new baseline", m_update);
+  }
+
+  bool IsEnabled (void) const
+  {
+    return m_enabled;
+  }
+
+  // Fix the seed, install the counting scheduler and start the clock, so
+  // topology construction is measured along with the run.  Must come before
+  // any node or random variable is created.
+  void Start (void)
+  {
+    if (!m_enabled)
+      {
+        return;
+      }
+    RngSeedManager::SetSeed (m_seed);
+    ObjectFactory scheduler;
+    scheduler.SetTypeId ("ns3::CountingMapScheduler");
+    Simulator::SetScheduler (scheduler);
+    m_events = CountingMapScheduler::Count ();
+    m_allocations = g_benchAllocations;
+    gettimeofday (&m_begin, 0);
+  }
+
+  // Report the run and compare it with the baseline; returns the exit
+  // status for main (): 1 on a regression, 2 when there is no baseline to
+  // compare against (unless --updateBaseline stores one)
+  int Finish (std::string const &scenario, uint32_t nodes)
+  {
+    if (!m_enabled)
+      {
+        return 0;
+      }
+    struct timeval end;
+    gettimeofday (&end, 0);
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+
+    Result r;
+    r.scenario = scenario;
+    r.nodes = nodes;
+    r.wall = (end.tv_sec - m_begin.tv_sec) + (end.tv_usec - m_begin.tv_usec) / 1e6;
+    r.events = CountingMapScheduler::Count () - m_events;
+    r.eventsPerSec = r.wall > 0 ? r.events / r.wall : 0;
+    r.peakRssKb = usage.ru_maxrss;
+    r.allocsPerEvent = r.events ? double (g_benchAllocations - m_allocations) / r.events : 0;
+
+    std::cout << "BENCH " << Format (r) << std::endl;
+
+    if (m_update)
+      {
+        StoreBaseline (r);
+        return 0;
+      }
+    Result base;
+    if (!LoadBaseline (scenario, nodes, base))
+      {
+        std::cout << "BENCH no baseline for " << scenario << " nodes=" << nodes
+                  << " in " << m_baseline << ", run with --updateBaseline" << std::endl;
+        return 2;
+      }
+    if (base.events != r.events)
+      {
+        std::cout << "BENCH note: event count changed from " << base.events
+                  << ", the scenario no longer simulates the same run" << std::endl;
+      }
+    // throughput the baseline would have at m_minWall more wall time
+    double slowEventsPerSec = base.events / (base.wall + m_minWall);
+    bool ok = true;
+    ok &= Check ("wall", r.wall, base.wall, true, m_minWall);
+    ok &= Check ("events/s", r.eventsPerSec, base.eventsPerSec, false,
+                 base.eventsPerSec - slowEventsPerSec);
+    ok &= Check ("peakRss", r.peakRssKb, base.peakRssKb, true, 0);
+    ok &= Check ("allocs/event", r.allocsPerEvent, base.allocsPerEvent, true, 0);
+    std::cout << "BENCH " << (ok ? "PASS " : "FAIL ") << scenario
+              << " nodes=" << nodes << std::endl;
+    return ok ? 0 : 1;
+  }
+
+private:
+  struct Result
+  {
+    std::string scenario;
+    uint32_t nodes;
+    double wall;
+    uint64_t events;
+    double eventsPerSec;
+    double peakRssKb;
+    double allocsPerEvent;
+  };
+
+  static std::string Format (Result const &r)
+  {
+    std::ostringstream os;
+    os << r.scenario << " " << r.nodes << " " << r.wall << " " << r.events
+       << " " << r.eventsPerSec << " " << r.peakRssKb << " " << r.allocsPerEvent;
+    return os.str ();
+  }
+
+  // higherIsWorse: wall time, memory and allocations regress upwards,
+  // throughput regresses downwards.  Differences up to slack never count.
+  bool Check (std::string const &what, double value, double base, bool higherIsWorse,
+              double slack) const
+  {
+    bool ok = higherIsWorse ? value <= std::max (base * (1 + m_tolerance), base + slack)
+                            : value >= std::min (base * (1 - m_tolerance), base - slack);
+    std::cout << "BENCH   " << what << " " << value << " baseline " << base
+              << (ok ? "" : "  REGRESSION") << std::endl;
+    return ok;
+  }
+
+  // Baseline file format, one run per line, '#' starts a comment:
+  //   <scenario> <nodes> <wall s> <events> <events/s> <peak RSS kB> <allocs/event>
+  bool LoadBaseline (std::string const &scenario, uint32_t nodes, Result &r) const
+  {
+    std::ifstream in (m_baseline.c_str ());
+    std::string line;
+    while (std::getline (in, line))
+      {
+        std::istringstream is (line);
+        if (line.empty () || line[0] == '#')
+          {
+            continue;
+          }
+        if (is >> r.scenario >> r.nodes >> r.wall >> r.events
+            >> r.eventsPerSec >> r.peakRssKb >> r.allocsPerEvent
+            && r.scenario == scenario && r.nodes == nodes)
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  void StoreBaseline (Result const &r) const
+  {
+    std::vector<std::string> lines;
+    std::ifstream in (m_baseline.c_str ());
+    std::string line;
+    while (std::getline (in, line))
+      {
+        std::istringstream is (line);
+        std::string scenario;
+        uint32_t nodes;
+        if (line.empty () || line[0] == '#'
+            || !(is >> scenario >> nodes)
+            || scenario != r.scenario || nodes != r.nodes)
+          {
+            lines.push_back (line);
+          }
+      }
+    in.close ();
+    lines.push_back (Format (r));
+    std::ofstream out (m_baseline.c_str ());
+    for (size_t i = 0; i < lines.size (); ++i)
+      {
+        out << lines[i] << std::endl;
+      }
+    std::cout << "BENCH baseline stored in " << m_baseline << std::endl;
+  }
+
+  bool m_enabled;
+  uint32_t m_seed;
+  std::string m_baseline;
+  double m_tolerance;
+  double m_minWall;
+  bool m_update;
+  uint64_t m_events;
+  uint64_t m_allocations;
+  struct timeval m_begin;
+};
+
+} // namespace ns3
+
+#if __cplusplus >= 201103L
+#define SCENARIO_BENCH_THROW_BAD_ALLOC
+#define SCENARIO_BENCH_NOTHROW noexcept
+#else
+#define SCENARIO_BENCH_THROW_BAD_ALLOC throw (std::bad_alloc)
+#define SCENARIO_BENCH_NOTHROW throw ()
+#endif
+
+// The array and nothrow forms of libstdc++ forward to these two
+void *
+operator new (std::size_t size) SCENARIO_BENCH_THROW_BAD_ALLOC
+{
+  ++ns3::g_benchAllocations;
+  void *p = std::malloc (size ? size : 1);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) SCENARIO_BENCH_NOTHROW
+{
+  std::free (p);
+}
+
+#endif /* SCENARIO_BENCH_H */
@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SLIM_STACK_HELPER_H
+#define SLIM_STACK_HELPER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/**
+ * Install a reduced protocol stack on leaf stations: IPv4, ARP, ICMPv4
+ * and UDP.
+ *
+ * InternetStackHelper also gives every node IPv6 with ICMPv6 and neighbor
+ * discovery, TCP and a packet socket factory.  Stations that only run a UDP
+ * echo client need none of these, and with thousands of them the unused
+ * objects dominate memory and construction time.  Sockets are still
+ * created on demand by the applications.
+ *
+ * The object factories and the routing helper are built once and shared by
+ * every Install call; routing is the same static + global list routing
+ * InternetStackHelper uses, so Ipv4GlobalRoutingHelper keeps working.
+ *
+ * ICMPv4 stays: Ipv4L3Protocol answers a datagram for an unbound port, e.g.
+ * a late echo reply after the client closed its socket, through it.
+ */
+class SlimStackHelper
+{
+public:
+  SlimStackHelper ()
+  {
+    m_arpFactory.SetTypeId ("ns3::ArpL3Protocol");
+    m_ipv4Factory.SetTypeId ("ns3::Ipv4L3Protocol");
+    m_icmpFactory.SetTypeId ("ns3::Icmpv4L4Protocol");
+    m_udpFactory.SetTypeId ("ns3::UdpL4Protocol");
+
+    Ipv4StaticRoutingHelper staticRouting;
+    Ipv4GlobalRoutingHelper globalRouting;
+    m_routing.Add (staticRouting, 0);
+    m_routing.Add (globalRouting, -10);
+  }
+
+  void Install (Ptr<Node> node) const
+  {
+    if (node->GetObject<Ipv4> () != 0)
+      {
+        NS_FATAL_ERROR ("SlimStackHelper::Install (): Aggregating "
+                        "an InternetStack to a node with an existing Ipv4 object");
+        return;
+      }
+    node->AggregateObject (m_arpFactory.Create<Object> ());
+    node->AggregateObject (m_ipv4Factory.Create<Object> ());
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+    node->AggregateObject (m_icmpFactory.Create<Object> ());
+    ipv4->SetRoutingProtocol (m_routing.Create (node));
+    node->AggregateObject (m_udpFactory.Create<Object> ());
+  }
+
+  void Install (NodeContainer c) const
+  {
+    for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+      {
+        Install (*i);
+      }
+  }
+
+private:
+  ObjectFactory m_arpFactory;
+  ObjectFactory m_ipv4Factory;
+  ObjectFactory m_icmpFactory;
+  ObjectFactory m_udpFactory;
+  Ipv4ListRoutingHelper m_routing;
+};
+
+} // namespace ns3
+
+#endif /* SLIM_STACK_HELPER_H */
@@ -0,0 +1,138 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef STATIC_ARP_H
+#define STATIC_ARP_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+#include <vector>
+
+namespace ns3 {
+
+namespace staticarp {
+
+// Every address on an interface that resolves through ARP, with the MAC
+// address of its device
+inline void
+CollectArpAddresses (std::vector<Ptr<Ipv4Interface> > &interfaces,
+                     std::vector<Ipv4Address> &addresses,
+                     std::vector<Address> &macs)
+{
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
+    {
+      Ptr<Ipv4L3Protocol> ip = (*i)->GetObject<Ipv4L3Protocol> ();
+      if (ip == 0)
+        {
+          continue;
+        }
+      for (uint32_t j = 0; j < ip->GetNInterfaces (); ++j)
+        {
+          Ptr<Ipv4Interface> iface = ip->GetInterface (j);
+          Ptr<NetDevice> device = iface->GetDevice ();
+          if (!device->NeedsArp ())
+            {
+              continue;
+            }
+          for (uint32_t k = 0; k < iface->GetNAddresses (); ++k)
+            {
+              Ipv4Address addr = iface->GetAddress (k).GetLocal ();
+              if (addr == Ipv4Address::GetLoopback ())
+                {
+                  continue;
+                }
+              addresses.push_back (addr);
+              macs.push_back (device->GetAddress ());
+            }
+          interfaces.push_back (iface);
+        }
+    }
+}
+
+// Assert the precondition of PopulateArpCache once the run has started
+inline void
+CheckArpCacheComplete (Ptr<ArpCache> arp)
+{
+  std::vector<Ptr<Ipv4Interface> > interfaces;
+  std::vector<Ipv4Address> addresses;
+  std::vector<Address> macs;
+  CollectArpAddresses (interfaces, addresses, macs);
+  for (uint32_t i = 0; i < interfaces.size (); ++i)
+    {
+      NS_ASSERT_MSG (interfaces[i]->GetArpCache () == arp,
+                     "interface added after PopulateArpCache");
+    }
+  for (uint32_t i = 0; i < addresses.size (); ++i)
+    {
+      NS_ASSERT_MSG (arp->Lookup (addresses[i]) != 0,
+                     "address " << addresses[i] << " assigned after PopulateArpCache");
+    }
+}
+
+} // namespace staticarp
+
+/**
+ * Fill the ARP caches of every node from the addresses already assigned,
+ * so the first packet of a flow does not wait for an ARP request/reply.
+ *
+ * Instead of one map per interface holding every neighbor, all interfaces
+ * that need ARP share a single cache with one permanent entry per address.
+ *
+ * Hard precondition: call it once, after every Ipv4AddressHelper::Assign
+ * and before Simulator::Run, and add no nodes or addresses afterwards.
+ * The shared cache belongs to no device, so a lookup miss would make
+ * ArpL3Protocol send an ARP request through a cache without device or
+ * interface.  Builds with asserts check at time 0 that every address is
+ * still covered.
+ *
+ * ArpL3Protocol keeps the per-interface caches it created; they are no
+ * longer used for lookups but are still updated by any ARP packet a node
+ * receives.
+ */
+inline void
+PopulateArpCache (void)
+{
+  Ptr<ArpCache> arp = CreateObject<ArpCache> ();
+
+  std::vector<Ptr<Ipv4Interface> > interfaces;
+  std::vector<Ipv4Address> addresses;
+  std::vector<Address> macs;
+  staticarp::CollectArpAddresses (interfaces, addresses, macs);
+  for (uint32_t i = 0; i < addresses.size (); ++i)
+    {
+      ArpCache::Entry *entry = arp->Add (addresses[i]);
+      entry->SetMacAddresss (macs[i]);
+      entry->MarkPermanent ();
+    }
+
+  for (uint32_t i = 0; i < interfaces.size (); ++i)
+    {
+      // still the cache ArpL3Protocol made for this device, i.e. called once
+      NS_ASSERT (interfaces[i]->GetArpCache () != 0
+                 && interfaces[i]->GetArpCache ()->GetDevice () == interfaces[i]->GetDevice ());
+      interfaces[i]->SetArpCache (arp);
+    }
+
+#ifdef NS3_ASSERT_ENABLE
+  Simulator::Schedule (Seconds (0), &staticarp::CheckArpCacheComplete, arp);
+#endif
+}
+
+} // namespace ns3
+
+#endif /* STATIC_ARP_H */